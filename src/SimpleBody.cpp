@@ -6,6 +6,8 @@
 
 #include "SimpleBody.hpp"
 
+#include "logger.hpp"
+
 #include "../../../src/cs-core/Settings.hpp"
 #include "../../../src/cs-core/SolarSystem.hpp"
 #include "../../../src/cs-graphics/TextureLoader.hpp"
@@ -21,6 +23,7 @@
 
 #include <glm/gtc/type_ptr.hpp>
 #include <utility>
+#include <vector>
 
 namespace csp::simplebodies {
 
@@ -31,6 +34,107 @@ const uint32_t GRID_RESOLUTION_Y = 100;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+namespace {
+
+// Creates a copy of the given 8-bit texture with an sRGB internal format, so that the texture unit
+// can decode it to linear space before filtering. The decoding can then be toggled per texture
+// with GL_TEXTURE_SRGB_DECODE_EXT. RGB8 / SRGB8 and RGBA8 / SRGB8_ALPHA8 are in the same view
+// compatibility class, hence all mipmap levels can be copied on the GPU without a round trip to
+// the CPU. As the texels and the sampler state are copied from the texture created by the
+// TextureLoader, orientation and filtering are the same as without hardware sRGB decoding. On
+// failure, nullptr is returned and the reason is stored in 'error'.
+std::unique_ptr<VistaTexture> createSRGBCopy(VistaTexture& source, std::string& error) {
+  if (source.GetTarget() != GL_TEXTURE_2D) {
+    error = "the texture is not a 2D texture";
+    return nullptr;
+  }
+
+  source.Bind();
+
+  GLint internalFormat = 0;
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+
+  GLenum srgbFormat = 0;
+  GLenum format     = 0;
+
+  if (internalFormat == GL_RGB8) {
+    srgbFormat = GL_SRGB8;
+    format     = GL_RGB;
+  } else if (internalFormat == GL_RGBA8) {
+    srgbFormat = GL_SRGB8_ALPHA8;
+    format     = GL_RGBA;
+  } else {
+    source.Unbind();
+    error = "the texture does not have 8 bits per channel";
+    return nullptr;
+  }
+
+  std::array<GLint, 4> samplerState{};
+  glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &samplerState[0]);
+  glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &samplerState[1]);
+  glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &samplerState[2]);
+  glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &samplerState[3]);
+
+  GLfloat anisotropy = 1.F;
+  if (GLEW_EXT_texture_filter_anisotropic) {
+    glGetTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, &anisotropy);
+  }
+
+  // Query the sizes of all mipmap levels which have been allocated by the TextureLoader.
+  std::vector<std::pair<GLint, GLint>> levelSizes;
+
+  for (GLint level = 0;; ++level) {
+    GLint width  = 0;
+    GLint height = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+
+    if (width == 0 || height == 0) {
+      break;
+    }
+
+    levelSizes.emplace_back(width, height);
+
+    if (width == 1 && height == 1) {
+      break;
+    }
+  }
+
+  source.Unbind();
+
+  auto texture = std::make_unique<VistaTexture>(GL_TEXTURE_2D);
+  texture->Bind();
+
+  for (size_t level = 0; level < levelSizes.size(); ++level) {
+    glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLint>(srgbFormat),
+        levelSizes[level].first, levelSizes[level].second, 0, format, GL_UNSIGNED_BYTE, nullptr);
+  }
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelSizes.size()) - 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, samplerState[0]);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, samplerState[1]);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, samplerState[2]);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, samplerState[3]);
+
+  if (GLEW_EXT_texture_filter_anisotropic) {
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+  }
+
+  texture->Unbind();
+
+  for (size_t level = 0; level < levelSizes.size(); ++level) {
+    glCopyImageSubData(source.GetId(), GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, 0,
+        texture->GetId(), GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, 0,
+        levelSizes[level].first, levelSizes[level].second, 1);
+  }
+
+  return texture;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 const char* SimpleBody::SPHERE_VERT = R"(
 uniform vec3 uSunDirection;
 uniform vec3 uRadii;
@@ -79,6 +183,7 @@ uniform sampler2D uSurfaceTexture;
 uniform float uAmbientBrightness;
 uniform float uSunIlluminance;
 uniform float uFarClip;
+uniform bool uDecodeSRGB;
 
 // inputs
 in vec2 vTexCoords;
@@ -100,9 +205,10 @@ void main()
 {
     oColor = texture(uSurfaceTexture, vTexCoords).rgb;
 
-    #ifdef ENABLE_HDR
+    // This is only required if the texture unit cannot do the sRGB decoding for us.
+    if (uDecodeSRGB) {
       oColor = SRGBtoLINEAR(oColor);
-    #endif
+    }
 
     oColor = oColor * uSunIlluminance;
 
@@ -167,11 +273,12 @@ SimpleBody::SimpleBody(std::shared_ptr<cs::core::Settings> settings,
   mSphereIBO.Release();
   mSphereVBO.Release();
 
-  // Recreate the shader if lighting or HDR rendering mode are toggled.
+  // Recreate the shader if the lighting mode is toggled. Toggling HDR rendering only changes the
+  // sRGB decoding of the surface texture, which is updated in the next call to Do().
   mEnableLightingConnection = mSettings->mGraphics.pEnableLighting.connect(
       [this](bool /*enabled*/) { mShaderDirty = true; });
-  mEnableHDRConnection =
-      mSettings->mGraphics.pEnableHDR.connect([this](bool /*enabled*/) { mShaderDirty = true; });
+  mEnableHDRConnection = mSettings->mGraphics.pEnableHDR.connect(
+      [this](bool /*enabled*/) { mSRGBDecodeDirty = mHardwareSRGBDecode; });
 
   // Add to scenegraph.
   VistaSceneGraph* pSG = GetVistaSystem()->GetGraphicsManager()->GetSceneGraph();
@@ -194,7 +301,30 @@ SimpleBody::~SimpleBody() {
 
 void SimpleBody::configure(Plugin::Settings::SimpleBody const& settings) {
   if (mSimpleBodySettings.mTexture != settings.mTexture) {
-    mTexture = cs::graphics::TextureLoader::loadFromFile(settings.mTexture);
+    mTexture            = cs::graphics::TextureLoader::loadFromFile(settings.mTexture);
+    mHardwareSRGBDecode = false;
+
+    // If supported, we let the texture unit convert the sRGB texels to linear space before
+    // filtering. Else the conversion is done in the fragment shader.
+    std::string error;
+
+    if (!mTexture) {
+      error = "the texture could not be loaded";
+    } else if (!GLEW_EXT_texture_sRGB_decode) {
+      error = "GL_EXT_texture_sRGB_decode is not supported";
+    } else if (!GLEW_ARB_copy_image) {
+      error = "GL_ARB_copy_image is not supported";
+    } else if (auto srgbTexture = createSRGBCopy(*mTexture, error)) {
+      mTexture            = std::move(srgbTexture);
+      mHardwareSRGBDecode = true;
+    }
+
+    if (!mHardwareSRGBDecode) {
+      logger().debug("Decoding sRGB texture '{}' in the fragment shader: {}.", settings.mTexture,
+          error);
+    }
+
+    mSRGBDecodeDirty = mHardwareSRGBDecode;
   }
   mSimpleBodySettings = settings;
 }
@@ -262,10 +392,6 @@ bool SimpleBody::Do() {
     // (Re-)create sphere shader.
     std::string defines = "#version 330\n";
 
-    if (mSettings->mGraphics.pEnableHDR.get()) {
-      defines += "#define ENABLE_HDR\n";
-    }
-
     if (mSettings->mGraphics.pEnableLighting.get()) {
       defines += "#define ENABLE_LIGHTING\n";
     }
@@ -318,7 +444,13 @@ bool SimpleBody::Do() {
       mShader.GetUniformLocation("uMatModelView"), 1, GL_FALSE, glm::value_ptr(matMV));
   glUniformMatrix4fv(mShader.GetUniformLocation("uMatProjection"), 1, GL_FALSE, glMatP.data());
 
+  // In HDR mode, the surface texture has to be converted to linear space. Without HDR, the sRGB
+  // values are used directly.
+  bool enableHDR = mSettings->mGraphics.pEnableHDR.get();
+
   mShader.SetUniform(mShader.GetUniformLocation("uSurfaceTexture"), 0);
+  mShader.SetUniform(
+      mShader.GetUniformLocation("uDecodeSRGB"), enableHDR && !mHardwareSRGBDecode ? 1 : 0);
   mShader.SetUniform(mShader.GetUniformLocation("uRadii"), static_cast<float>(mRadii[0]),
       static_cast<float>(mRadii[0]), static_cast<float>(mRadii[0]));
   mShader.SetUniform(
@@ -326,6 +458,13 @@ bool SimpleBody::Do() {
 
   mTexture->Bind(GL_TEXTURE0);
 
+  // This is texture state. It would be overridden if a sampler object were bound to unit 0.
+  if (mSRGBDecodeDirty) {
+    glTexParameteri(mTexture->GetTarget(), GL_TEXTURE_SRGB_DECODE_EXT,
+        enableHDR ? GL_DECODE_EXT : GL_SKIP_DECODE_EXT);
+    mSRGBDecodeDirty = false;
+  }
+
   // Draw.
   mSphereVAO.Bind();
   glDrawElements(GL_TRIANGLE_STRIP, (GRID_RESOLUTION_X - 1) * (2 + 2 * GRID_RESOLUTION_Y),
@@ -76,6 +76,8 @@ class SimpleBody : public cs::scene::CelestialBody, public IVistaOpenGLDraw {
   glm::dvec3 mRadii;
 
   bool mShaderDirty              = true;
+  bool mHardwareSRGBDecode       = false;
+  bool mSRGBDecodeDirty          = false;
   int  mEnableLightingConnection = -1;
   int  mEnableHDRConnection      = -1;
 